@@ -3,6 +3,7 @@ package main
 // #cgo CFLAGS: -g -Wall
 // #include <stdlib.h>
 // #include "f_to_c.h"
+// #include "ring.h"
 import "C"
 
 import "fmt"
@@ -11,4 +12,20 @@ func main() {
 	fmt.Print("32 degrees Fahrenheit is:")
 	c := C.f_to_c(32)
 	fmt.Println(c)
+
+	// Batched variant: C queues readings into a ring in C memory and Go
+	// drains them in batches, one cgo call per batch instead of per value.
+	r := C.ring_new()
+	defer C.ring_free(r)
+	queued := C.ring_fill(r, 32, 48)
+	fmt.Println("queued", queued, "readings on the C side")
+
+	out := make([]C.double, 16)
+	for {
+		n := C.ring_drain(r, &out[0], C.int(len(out)))
+		if n == 0 {
+			break
+		}
+		fmt.Println("drained", n, "readings in one call:", out[:n])
+	}
 }
@@ -0,0 +1,44 @@
+#include "ring.h"
+#include "f_to_c.h"
+#include <stdlib.h>
+
+struct temp_ring *ring_new(void) {
+   return calloc(1, sizeof(struct temp_ring));
+}
+
+void ring_free(struct temp_ring *r) {
+   free(r);
+}
+
+/* Returns 0 when the reading was queued, -1 when the ring is full. */
+int ring_push(struct temp_ring *r, int fahr) {
+   if (r->head - r->tail == RING_SIZE) {
+      return -1;
+   }
+   r->fahr[r->head % RING_SIZE] = fahr;
+   r->head++;
+   return 0;
+}
+
+/* Stands in for C callers submitting work: queues n readings starting at
+ * first and returns how many fit. */
+int ring_fill(struct temp_ring *r, int first, int n) {
+   int i;
+   for (i = 0; i < n; i++) {
+      if (ring_push(r, first + i) < 0) {
+         break;
+      }
+   }
+   return i;
+}
+
+/* Converts up to max queued readings into out and returns how many were
+ * drained. out may point into Go memory. */
+int ring_drain(struct temp_ring *r, double *out, int max) {
+   int n = 0;
+   while (n < max && r->tail != r->head) {
+      out[n++] = f_to_c(r->fahr[r->tail % RING_SIZE]);
+      r->tail++;
+   }
+   return n;
+}
@@ -0,0 +1,20 @@
+#ifndef _TEMP_RING
+#define _TEMP_RING
+
+#define RING_SIZE 64
+
+/* Fixed-size ring living in C memory. The C side pushes readings, Go drains
+ * them in batches so that one cgo call covers many entries. */
+struct temp_ring {
+   int fahr[RING_SIZE];
+   unsigned int head;
+   unsigned int tail;
+};
+
+struct temp_ring *ring_new(void);
+void ring_free(struct temp_ring *r);
+int ring_push(struct temp_ring *r, int fahr);
+int ring_fill(struct temp_ring *r, int first, int n);
+int ring_drain(struct temp_ring *r, double *out, int max);
+
+#endif
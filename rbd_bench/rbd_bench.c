@@ -0,0 +1,452 @@
+#define _GNU_SOURCE
+#include <rados/librados.h>
+#include <rbd/librbd.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Allocation accounting. The executable's malloc family interposes the one
+ * used by librbd.so (and its cgo C.malloc calls), so every C heap allocation
+ * made while the benchmark runs is counted. Go heap allocations are not
+ * visible here.
+ *
+ * Counters are per thread so that counting does not add a shared cache line
+ * to every IO. Each thread's counters are allocated on its first malloc,
+ * pushed onto a global list and never freed, so main can sum them while Go
+ * and librados threads are still running, or after a thread has exited.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *p);
+
+struct alloc_stats {
+   uint64_t allocs;
+   uint64_t bytes;
+   struct alloc_stats *next;
+} __attribute__((aligned(64)));
+
+static struct alloc_stats *all_stats;
+static __thread struct alloc_stats *thread_stats;
+
+static void count_alloc(size_t size) {
+   struct alloc_stats *s = thread_stats;
+
+   if (!s) {
+      s = __libc_memalign(64, sizeof(*s));
+      if (!s) {
+         return;
+      }
+      memset(s, 0, sizeof(*s));
+      s->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+      while (!__atomic_compare_exchange_n(&all_stats, &s->next, s, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      }
+      thread_stats = s;
+   }
+   /* Only the owning thread writes; relaxed stores keep reads untorn. */
+   __atomic_store_n(&s->allocs, s->allocs + 1, __ATOMIC_RELAXED);
+   __atomic_store_n(&s->bytes, s->bytes + size, __ATOMIC_RELAXED);
+}
+
+static void sum_allocs(uint64_t *allocs, uint64_t *bytes) {
+   struct alloc_stats *s;
+
+   *allocs = 0;
+   *bytes = 0;
+   for (s = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE); s; s = s->next) {
+      *allocs += __atomic_load_n(&s->allocs, __ATOMIC_RELAXED);
+      *bytes += __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+   }
+}
+
+void *malloc(size_t size) {
+   count_alloc(size);
+   return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+   count_alloc(n * size);
+   return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+   count_alloc(size);
+   return __libc_realloc(p, size);
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+   count_alloc(size);
+   return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **p, size_t align, size_t size) {
+   count_alloc(size);
+   *p = __libc_memalign(align, size);
+   return *p ? 0 : ENOMEM;
+}
+
+void free(void *p) {
+   __libc_free(p);
+}
+
+enum op { OP_WRITE, OP_READ, OP_FLUSH };
+
+struct config {
+   const char *conf;
+   const char *client;
+   const char *pool;
+   const char *image;
+   enum op op;
+   int threads;
+   int depth;
+   long ops;
+   size_t bs;
+};
+
+struct slot {
+   rbd_completion_t comp;
+   char *buf;
+   uint64_t submitted;
+   uint64_t completed;
+};
+
+/* Workers wait here after setup so that main can snapshot the counters
+ * before the first submission, or call the run off if a thread failed to
+ * start. */
+struct gate {
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+   int ready;
+   int state;
+};
+
+static struct gate gate = {
+   .lock = PTHREAD_MUTEX_INITIALIZER,
+   .cond = PTHREAD_COND_INITIALIZER,
+};
+
+struct worker {
+   pthread_t tid;
+   const struct config *cfg;
+   rbd_image_t image;
+   uint64_t size;
+   uint64_t rng;
+   uint64_t lat_ns;
+   long done;
+   int err;
+};
+
+static uint64_t now_ns(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Returns 1 once main opens the gate, -1 if the run was called off. */
+static int gate_arrive(void) {
+   int state;
+
+   pthread_mutex_lock(&gate.lock);
+   gate.ready++;
+   pthread_cond_broadcast(&gate.cond);
+   while (!gate.state) {
+      pthread_cond_wait(&gate.cond, &gate.lock);
+   }
+   state = gate.state;
+   pthread_mutex_unlock(&gate.lock);
+   return state;
+}
+
+static void gate_wait_ready(int n) {
+   pthread_mutex_lock(&gate.lock);
+   while (gate.ready < n) {
+      pthread_cond_wait(&gate.cond, &gate.lock);
+   }
+   pthread_mutex_unlock(&gate.lock);
+}
+
+static void gate_open(int state) {
+   pthread_mutex_lock(&gate.lock);
+   gate.state = state;
+   pthread_cond_broadcast(&gate.cond);
+   pthread_mutex_unlock(&gate.lock);
+}
+
+/* xorshift64; rand_r() tops out at 2^31 blocks, short of large images. */
+static uint64_t next_rand(uint64_t *x) {
+   *x ^= *x << 13;
+   *x ^= *x >> 7;
+   *x ^= *x << 17;
+   return *x;
+}
+
+static void complete_cb(rbd_completion_t c, void *arg) {
+   struct slot *s = arg;
+
+   (void)c;
+   __atomic_store_n(&s->completed, now_ns(), __ATOMIC_RELEASE);
+}
+
+static int submit(struct worker *w, struct slot *s) {
+   const struct config *cfg = w->cfg;
+   uint64_t blocks = w->size / cfg->bs;
+   uint64_t off = (next_rand(&w->rng) % blocks) * cfg->bs;
+   int r;
+
+   s->completed = 0;
+   r = rbd_aio_create_completion(s, complete_cb, &s->comp);
+   if (r < 0) {
+      return r;
+   }
+   s->submitted = now_ns();
+   switch (cfg->op) {
+   case OP_WRITE:
+      r = rbd_aio_write(w->image, off, cfg->bs, s->buf, s->comp);
+      break;
+   case OP_READ:
+      r = rbd_aio_read(w->image, off, cfg->bs, s->buf, s->comp);
+      break;
+   case OP_FLUSH:
+      r = rbd_aio_flush(w->image, s->comp);
+      break;
+   }
+   if (r < 0) {
+      rbd_aio_release(s->comp);
+   }
+   return r;
+}
+
+/*
+ * Latency is taken from the completion callback, so waiting on an older
+ * request does not inflate a younger one that finished first. If the
+ * callback has not run by the time the wait returns, fall back to now.
+ */
+static int reap(struct worker *w, struct slot *s) {
+   uint64_t completed;
+   int r;
+
+   rbd_aio_wait_for_complete(s->comp);
+   completed = __atomic_load_n(&s->completed, __ATOMIC_ACQUIRE);
+   w->lat_ns += (completed ? completed : now_ns()) - s->submitted;
+   r = rbd_aio_get_return_value(s->comp);
+   rbd_aio_release(s->comp);
+   w->done++;
+   return r < 0 ? r : 0;
+}
+
+/* Keeps depth requests in flight, reaping them in submission order. */
+static void *run(void *arg) {
+   struct worker *w = arg;
+   const struct config *cfg = w->cfg;
+   struct slot *slots;
+   long submitted = 0;
+   int i, r;
+
+   slots = calloc(cfg->depth, sizeof(*slots));
+   if (!slots) {
+      w->err = -ENOMEM;
+      gate_arrive();
+      return NULL;
+   }
+   for (i = 0; i < cfg->depth; i++) {
+      if (posix_memalign((void **)&slots[i].buf, 4096, cfg->bs)) {
+         w->err = -ENOMEM;
+         break;
+      }
+      memset(slots[i].buf, 0xab, cfg->bs);
+   }
+
+   if (gate_arrive() < 0 || w->err) {
+      goto out;
+   }
+
+   for (i = 0; i < cfg->depth && submitted < cfg->ops; i++, submitted++) {
+      if ((r = submit(w, &slots[i])) < 0) {
+         w->err = r;
+         goto drain;
+      }
+   }
+   i = 0;
+   while (w->done < submitted) {
+      if ((r = reap(w, &slots[i])) < 0) {
+         w->err = r;
+      }
+      if (!w->err && submitted < cfg->ops) {
+         if ((r = submit(w, &slots[i])) < 0) {
+            w->err = r;
+         } else {
+            submitted++;
+         }
+      }
+      i = (i + 1) % cfg->depth;
+   }
+   goto out;
+
+drain:
+   /* Slots before i were submitted; reap them before freeing buffers. */
+   while (i-- > 0) {
+      reap(w, &slots[i]);
+   }
+out:
+   for (i = 0; i < cfg->depth; i++) {
+      free(slots[i].buf);
+   }
+   free(slots);
+   return NULL;
+}
+
+static void usage(const char *prog) {
+   fprintf(stderr,
+           "usage: %s [-c ceph.conf] [-u client] [-p pool] [-i image]\n"
+           "          [-o write|read|flush] [-t threads] [-d depth]\n"
+           "          [-n ops per thread] [-b block size]\n",
+           prog);
+   exit(2);
+}
+
+static void parse(struct config *cfg, int argc, char **argv) {
+   int c;
+
+   while ((c = getopt(argc, argv, "c:u:p:i:o:t:d:n:b:")) != -1) {
+      switch (c) {
+      case 'c': cfg->conf = optarg; break;
+      case 'u': cfg->client = optarg; break;
+      case 'p': cfg->pool = optarg; break;
+      case 'i': cfg->image = optarg; break;
+      case 't': cfg->threads = atoi(optarg); break;
+      case 'd': cfg->depth = atoi(optarg); break;
+      case 'n': cfg->ops = atol(optarg); break;
+      case 'b': cfg->bs = strtoul(optarg, NULL, 0); break;
+      case 'o':
+         if (!strcmp(optarg, "write")) {
+            cfg->op = OP_WRITE;
+         } else if (!strcmp(optarg, "read")) {
+            cfg->op = OP_READ;
+         } else if (!strcmp(optarg, "flush")) {
+            cfg->op = OP_FLUSH;
+         } else {
+            usage(argv[0]);
+         }
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+   if (cfg->threads < 1 || cfg->depth < 1 || cfg->ops < 1 || cfg->bs < 512) {
+      usage(argv[0]);
+   }
+}
+
+int main(int argc, char **argv) {
+   static const char *op_names[] = { "write", "read", "flush" };
+   struct config cfg = {
+      .conf = NULL,
+      .client = "admin",
+      .pool = "rbd",
+      .image = "fio_bd",
+      .op = OP_WRITE,
+      .threads = 1,
+      .depth = 32,
+      .ops = 100000,
+      .bs = 4096,
+   };
+   rados_t cluster;
+   rados_ioctx_t ioctx;
+   rbd_image_t image;
+   rbd_image_info_t info;
+   struct worker *workers;
+   uint64_t t0, elapsed, a0, b0, a1, b1, lat_ns = 0;
+   long total = 0;
+   int i, r, started, err = 0;
+
+   parse(&cfg, argc, argv);
+
+   if ((r = rados_create(&cluster, cfg.client)) < 0 ||
+       (r = rados_conf_read_file(cluster, cfg.conf)) < 0 ||
+       (r = rados_connect(cluster)) < 0) {
+      fprintf(stderr, "rados setup failed: %s\n", strerror(-r));
+      return 1;
+   }
+   if ((r = rados_ioctx_create(cluster, cfg.pool, &ioctx)) < 0) {
+      fprintf(stderr, "rados_ioctx_create %s: %s\n", cfg.pool, strerror(-r));
+      return 1;
+   }
+   if ((r = rbd_open(ioctx, cfg.image, &image, NULL)) < 0) {
+      fprintf(stderr, "rbd_open %s: %s\n", cfg.image, strerror(-r));
+      return 1;
+   }
+   if ((r = rbd_stat(image, &info, sizeof(info))) < 0 || info.size < cfg.bs) {
+      fprintf(stderr, "rbd_stat %s: %s\n", cfg.image, r < 0 ? strerror(-r) : "image too small");
+      return 1;
+   }
+
+   workers = calloc(cfg.threads, sizeof(*workers));
+   if (!workers) {
+      fprintf(stderr, "out of memory\n");
+      err = -ENOMEM;
+      goto close;
+   }
+   for (started = 0; started < cfg.threads; started++) {
+      workers[started].cfg = &cfg;
+      workers[started].image = image;
+      workers[started].size = info.size;
+      workers[started].rng = started + 1;
+      r = pthread_create(&workers[started].tid, NULL, run, &workers[started]);
+      if (r) {
+         fprintf(stderr, "pthread_create: %s\n", strerror(r));
+         err = -r;
+         break;
+      }
+   }
+
+   /* Snapshot counters between setup and the first submission. */
+   gate_wait_ready(started);
+   sum_allocs(&a0, &b0);
+   t0 = now_ns();
+   gate_open(err ? -1 : 1);
+   for (i = 0; i < started; i++) {
+      pthread_join(workers[i].tid, NULL);
+   }
+   elapsed = now_ns() - t0;
+   sum_allocs(&a1, &b1);
+   if (err) {
+      goto out;
+   }
+
+   for (i = 0; i < cfg.threads; i++) {
+      total += workers[i].done;
+      lat_ns += workers[i].lat_ns;
+      if (workers[i].err && !err) {
+         err = workers[i].err;
+      }
+   }
+   if (err) {
+      fprintf(stderr, "%s failed: %s\n", op_names[cfg.op], strerror(-err));
+   }
+
+   if (total > 0) {
+      printf("op=%s threads=%d depth=%d bs=%zu ops=%ld\n",
+             op_names[cfg.op], cfg.threads, cfg.depth, cfg.bs, total);
+      printf("%.0f IOPS, %.1f ns/op, %.1f us avg latency, %.2f allocs/op, %.1f B/op\n",
+             total * 1e9 / elapsed, (double)elapsed * cfg.threads / total,
+             lat_ns / 1e3 / total, (double)(a1 - a0) / total,
+             (double)(b1 - b0) / total);
+   }
+
+out:
+   free(workers);
+close:
+   rbd_close(image);
+   rados_ioctx_destroy(ioctx);
+   rados_shutdown(cluster);
+   return err ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+# Shared setup sourced by the run-*.sh benchmark scripts.
+#
+# Detects the bs3 backend from its config (null = true means the null
+# backend, anything else the S3/MinIO one) unless BACKEND is set, and creates
+# the results directory $OUT, by default results/<version>-<backend>.
+
+: "${BS3_CONFIG:=/etc/bs3/config.toml}"
+: "${VERSION:=unknown}"
+
+if [ -z "$BACKEND" ]; then
+  if grep -Eq '^null *= *true' "$BS3_CONFIG" 2>/dev/null; then
+    BACKEND=null
+  else
+    BACKEND=s3
+  fi
+fi
+
+: "${OUT:=results/$VERSION-$BACKEND}"
+mkdir -p "$OUT"
@@ -0,0 +1,34 @@
+#! /bin/sh
+#
+# Compares two summary.csv files from run-fio-matrix.sh and prints every job
+# whose IOPS dropped or p99 latency grew by more than $THRESHOLD percent.
+# Exits 1 when a regression is found so it can gate CI.
+#
+# Usage: ./compare.sh results/<old>/summary.csv results/<new>/summary.csv
+
+set -e
+
+if [ $# -ne 2 ]; then
+  echo "usage: $0 <baseline summary.csv> <candidate summary.csv>" >&2
+  exit 2
+fi
+
+: "${THRESHOLD:=10}"
+
+awk -F, -v t="$THRESHOLD" '
+  function unq(s) { gsub(/"/, "", s); return s }
+  function worse_iops(old, new) { return old > 0 && new < old * (1 - t / 100) }
+  function worse_lat(old, new) { return old > 0 && new > old * (1 + t / 100) }
+  FNR == 1 { next }
+  NR == FNR { base[unq($1)] = $0; next }
+  {
+    job = unq($1)
+    if (!(job in base)) next
+    split(base[job], o, ",")
+    if (worse_iops(o[6], $6)) { printf "%s read_iops %s -> %s\n", job, o[6], $6; bad = 1 }
+    if (worse_iops(o[9], $9)) { printf "%s write_iops %s -> %s\n", job, o[9], $9; bad = 1 }
+    if (worse_lat(o[8], $8)) { printf "%s read_p99_us %s -> %s\n", job, o[8], $8; bad = 1 }
+    if (worse_lat(o[11], $11)) { printf "%s write_p99_us %s -> %s\n", job, o[11], $11; bad = 1 }
+  }
+  END { exit bad }
+' "$1" "$2"
@@ -0,0 +1,57 @@
+#! /bin/sh
+#
+# Runs rbd-matrix.fio over a block size / pattern / iodepth / numjobs matrix
+# against the shim (LD_PRELOAD) and writes one fio JSON file per run plus a
+# summary.csv to $OUT. Point /etc/bs3/config.toml at the backend to measure
+# (null = true or MinIO) before running; the backend is recorded in the
+# results directory name.
+#
+# Usage: LIBRBD=./librbd.so VERSION=$(git rev-parse --short HEAD) ./run-fio-matrix.sh
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+
+: "${LIBRBD:=./librbd.so}"
+: "${FIO:=fio}"
+
+export CLIENT="${CLIENT:-admin}"
+export POOL="${POOL:-rbd}"
+export RBDNAME="${RBDNAME:-fio_bd}"
+export RUNTIME="${RUNTIME:-30}"
+export RAMP="${RAMP:-5}"
+
+: "${BS_LIST:=4k 64k 1M}"
+: "${RW_LIST:=randread randwrite write randrw}"
+: "${IODEPTH_LIST:=1 4 16 32 128}"
+: "${NUMJOBS_LIST:=1 4 16}"
+
+. "$here/common.sh"
+
+summary="$OUT/summary.csv"
+echo "job,bs,rw,iodepth,numjobs,read_iops,read_bw_kib,read_p99_us,write_iops,write_bw_kib,write_p99_us" > "$summary"
+
+for bs in $BS_LIST; do
+  for rw in $RW_LIST; do
+    for iodepth in $IODEPTH_LIST; do
+      for numjobs in $NUMJOBS_LIST; do
+        job="$rw-$bs-qd$iodepth-j$numjobs"
+        echo "running $job"
+        BS=$bs RW=$rw IODEPTH=$iodepth NUMJOBS=$numjobs \
+          LD_PRELOAD="$LIBRBD" "$FIO" --output-format=json \
+          --output="$OUT/$job.json" "$here/rbd-matrix.fio"
+        jq -r --arg job "$job" --arg bs "$bs" --arg rw "$rw" \
+          --arg qd "$iodepth" --arg nj "$numjobs" '
+          .jobs[0] as $j
+          | [$job, $bs, $rw, $qd, $nj,
+             $j.read.iops, $j.read.bw,
+             (($j.read.clat_ns.percentile["99.000000"] // 0) / 1000),
+             $j.write.iops, $j.write.bw,
+             (($j.write.clat_ns.percentile["99.000000"] // 0) / 1000)]
+          | @csv' "$OUT/$job.json" >> "$summary"
+      done
+    done
+  done
+done
+
+echo "results in $OUT"
@@ -0,0 +1,77 @@
+#! /bin/sh
+#
+# qemu-io scenario against the shim: large sequential write, verified
+# read-back, a small overwrite and a flush. Timings parsed from qemu-io's output go to
+# $OUT/qemu-io.csv next to the fio results.
+#
+# Usage: LIBRBD=./librbd.so VERSION=$(git rev-parse --short HEAD) ./run-qemu-io.sh
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+
+: "${LIBRBD:=./librbd.so}"
+: "${QEMU_IO:=qemu-io}"
+: "${POOL:=rbd}"
+: "${RBDNAME:=qemu_bd}"
+: "${CEPH_CONF:=$HOME/ceph/build/ceph.conf}"
+: "${SIZE:=64M}"
+
+. "$here/common.sh"
+
+# The null backend drops data, so only verify the pattern against a real one.
+verify="-P 0xab"
+if [ "$BACKEND" = null ]; then
+  verify=""
+fi
+
+# Write straight to the log so a failed open or a crash fails the script.
+if ! LD_PRELOAD="$LIBRBD" "$QEMU_IO" -f raw \
+  -c "write -P 0xab 0 $SIZE" \
+  -c "read $verify 0 $SIZE" \
+  -c "write -P 0xcd 0 4k" \
+  -c "flush" \
+  "rbd:$POOL/$RBDNAME:conf=$CEPH_CONF" > "$OUT/qemu-io.log" 2>&1; then
+  cat "$OUT/qemu-io.log"
+  echo "qemu-io failed" >&2
+  exit 1
+fi
+cat "$OUT/qemu-io.log"
+
+if grep -q "Pattern verification failed" "$OUT/qemu-io.log"; then
+  echo "read-back pattern verification failed" >&2
+  exit 1
+fi
+
+# qemu-io reports each op as e.g.
+#   wrote 67108864/67108864 bytes at offset 0
+#   64 MiB, 1 ops; 0.250 sec (256 MiB/sec and 4 ops/sec)
+# and switches to H:MM:SS.ss once an op takes a second or more:
+#   64 MiB, 1 ops; 0:00:01.50 (42.667 MiB/sec and 0.6667 ops/sec)
+echo "op,bytes,ops,sec" > "$OUT/qemu-io.csv"
+awk '
+  /^wrote |^read / {
+    if (op != "") { print "no timing for " op > "/dev/stderr"; failed = 1; exit }
+    op = $1; split($2, b, "/"); bytes = b[1]; next
+  }
+  / ops; / {
+    for (i = 1; i <= NF; i++) if ($i == "ops;") break
+    if (op == "" || i >= NF) next
+    ops = $(i-1); t = $(i+1)
+    if ($(i+2) == "sec") {
+      sec = t
+    } else {
+      n = split(t, hms, ":")
+      if (n != 3) { print "unparsed timing: " $0 > "/dev/stderr"; failed = 1; exit }
+      sec = hms[1] * 3600 + hms[2] * 60 + hms[3]
+    }
+    print op "," bytes "," ops "," sec
+    op = ""
+  }
+  END {
+    if (!failed && op != "") { print "no timing for " op > "/dev/stderr"; failed = 1 }
+    exit failed
+  }
+' "$OUT/qemu-io.log" >> "$OUT/qemu-io.csv"
+
+echo "results in $OUT"
@@ -0,0 +1,53 @@
+#! /bin/sh
+#
+# Sweeps rbd_bench over 1..64 submitting threads and writes write IOPS per
+# thread count to $OUT/thread-scaling.csv. Use it to check that write IOPS
+# scale with submitters, e.g. for contention on per-domain write counters.
+# Run with the null backend to isolate the shim and bs3 from the object store.
+#
+# Usage: LIBRBD=./librbd.so RBD_BENCH=./rbd_bench/rbd_bench VERSION=$(git rev-parse --short HEAD) ./run-thread-scaling.sh
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+
+: "${LIBRBD:=./librbd.so}"
+: "${RBD_BENCH:=./rbd_bench/rbd_bench}"
+: "${CEPH_CONF:=$HOME/ceph/build/ceph.conf}"
+: "${POOL:=rbd}"
+: "${RBDNAME:=fio_bd}"
+: "${OP:=write}"
+: "${BS:=4096}"
+: "${DEPTH:=32}"
+: "${OPS:=100000}"
+: "${THREADS_LIST:=1 2 4 8 16 32 64}"
+
+. "$here/common.sh"
+
+csv="$OUT/thread-scaling.csv"
+rows="$OUT/thread-scaling.rows"
+: > "$rows"
+
+for threads in $THREADS_LIST; do
+  echo "running $OP with $threads threads"
+  log="$OUT/rbd_bench-$OP-t$threads.log"
+  LD_PRELOAD="$LIBRBD" "$RBD_BENCH" -c "$CEPH_CONF" -p "$POOL" -i "$RBDNAME" \
+    -o "$OP" -t "$threads" -d "$DEPTH" -n "$OPS" -b "$BS" > "$log"
+  # rbd_bench prints "<iops> IOPS, <ns> ns/op, <us> us avg latency, <n> allocs/op, ..."
+  line=$(awk '/ IOPS, / { print $1 "," $3 "," $5 "," $9 }' "$log")
+  if [ -z "$line" ]; then
+    echo "no result in $log" >&2
+    exit 1
+  fi
+  echo "$OP,$threads,$DEPTH,$BS,$line" >> "$rows"
+done
+
+# Speedup is relative to the threads=1 run; left empty when there is none.
+echo "op,threads,depth,bs,iops,ns_per_op,avg_lat_us,allocs_per_op,speedup" > "$csv"
+awk -F, '
+  NR == FNR { if ($2 == 1) base = $5; next }
+  { printf "%s,%s\n", $0, (base > 0 ? sprintf("%.2f", $5 / base) : "") }
+' "$rows" "$rows" >> "$csv"
+rm -f "$rows"
+
+cat "$csv"